@@ -3,16 +3,22 @@
 
 #include<iostream>
 #include<cstdlib>
+#include<climits>
+#include<algorithm>
 #include<vector>
-#include<map>
-#include<queue>
+#include<deque>
+#ifdef PROFILE
+#include "profile.h"
+#else
+#define PROFILE_PHASE(name)
+#endif
 using namespace std;
 
 /*
   This is a graph theory (source->sink) problem in disguise.
   You might be able to solve this without graphs, but I couldn't
   find a solution that way.
-  We setup the graph, then use the Ford-Fulkerson algorithm to
+  We setup the graph, then use the Boykov-Kolmogorov algorithm to
   determine the max flow.
   The max flow coming in the sink should be equal to the number
   of banks.
@@ -21,156 +27,250 @@ using namespace std;
 // // for testing...
 // map<int, string> NAMES;
 
-//============================================================
-// FordFulkerson
-//============================================================
+// graph[from] = the edges leaving vertex from.
 struct edge{
   int to;
   int capacity;
 };
 
-struct flow_edge{
-  int flow;
-  int c_f;
-  flow_edge()
-      : flow(0), c_f(0){}
-};
-
-class FordFulkerson
+//============================================================
+// BoykovKolmogorov
+//============================================================
+/*
+  Max flow with the Boykov-Kolmogorov algorithm. Instead of starting
+  a new BFS from the source for each augmenting path (Ford-Fulkerson /
+  Edmonds-Karp), it grows a search tree from the source and one from
+  the sink, and keeps both trees between augmentations. After pushing
+  flow only the vertices cut off from their tree (orphans) are fixed.
+  This works well for the low degree grid graphs we get here.
+*/
+class BoykovKolmogorov
 {
 public:
-  FordFulkerson(const vector<vector<edge> > &graph)
-      : _graph(graph)
-  {}
-
-  /*
-    INPUT: source and sink indices.
-    OUTPUT: flow in/out for each vertex.
-    returns max flow.
-    flows should be empty. It will return the flows for each edge.
-  */
-  int MaxFlow(
-    int source_idx, int sink_idx,
-    map<int, map<int, flow_edge> >  &flows)
+  BoykovKolmogorov(const vector<vector<edge> > &graph)
   {
-    int max_flow = 0;
+    const int n = graph.size();
+
+    // Build the residual graph.
+    // Arcs for a vertex are stored together, first its edges from
+    // graph (in the same order), then the reverse arcs of the edges
+    // coming in, with zero capacity.
+    // So edge graph[from][k] is arc _first[from] + k.
+    _first.assign(n + 1, 0);
+    for(int from = 0;from < n; ++from)
+      for(const edge &e : graph[from]) {
+        ++_first[from + 1];
+        ++_first[e.to + 1];
+      }
+    for(int v = 0;v < n; ++v)
+      _first[v + 1] += _first[v];
+
+    _to.resize(_first[n]);
+    _c_f.resize(_first[n]);
+    _rev.resize(_first[n]);
+    vector<int> back_pos(n);
+    for(int v = 0;v < n; ++v)
+      back_pos[v] = _first[v] + graph[v].size();
+    for(int from = 0;from < n; ++from)
+      for(size_t k = 0;k < graph[from].size(); ++k) {
+        const edge &e = graph[from][k];
+        int a = _first[from] + k;
+        int b = back_pos[e.to]++;
+        _to[a] = e.to;  _c_f[a] = e.capacity; _rev[a] = b;
+        _to[b] = from;  _c_f[b] = 0;          _rev[b] = a;
+      }
+  }
 
-    // keep track of "backwards" edges for the residual graph.
-    vector<vector<edge> > back_graph(_graph.size());
+  // returns max flow.
+  int MaxFlow(int source_idx, int sink_idx) {
+    const int n = _first.size() - 1;
+    _tree.assign(n, FREE);
+    _parent.assign(n, NO_PARENT);
+    _ts.assign(n, 0);
+    _dist.assign(n, 0);
+    _time = 0;
+    _active.clear();
+    _orphans.clear();
+
+    _tree[source_idx] = S_TREE;
+    _parent[source_idx] = TERMINAL;
+    _tree[sink_idx] = T_TREE;
+    _parent[sink_idx] = TERMINAL;
+    _active.push_back(source_idx);
+    _active.push_back(sink_idx);
 
-    // initialize flow
-    for(int from = 0;from < _graph.size(); ++from) {
-      for(int to_idx = 0; to_idx < _graph[from].size(); ++to_idx){
+    int max_flow = 0;
+    while(!_active.empty()) {
+      int p = _active.front();
+      _active.pop_front();
+      if(_tree[p] == FREE) continue; // was freed after it was made active.
+
+      // ===== Grow =====
+      // meet = arc going from the S tree into the T tree.
+      int meet = -1;
+      for(int a = _first[p]; a < _first[p + 1]; ++a) {
+        int q = _to[a];
+        // residual capacity in the direction away from the tree root.
+        int c = _tree[p] == S_TREE ? _c_f[a] : _c_f[_rev[a]];
+        if(c <= 0) continue;
+
+        if(_tree[q] == FREE) {
+          _tree[q] = _tree[p];
+          _parent[q] = _rev[a]; // arc from q to its parent p.
+          _ts[q] = _ts[p];
+          _dist[q] = _dist[p] + 1;
+          _active.push_back(q);
+        }else if(_tree[q] != _tree[p]) {
+          meet = _tree[p] == S_TREE ? a : _rev[a];
+          break;
+        }
+      }
+      if(meet < 0) continue; // p has no more free neighbors.
 
-        int to = _graph[from][to_idx].to;
+      // p might still have more neighbors to grow into.
+      _active.push_front(p);
 
-        // push an edge going backwards, with zero capacity.
-        edge t = {from,0};
-        back_graph[to].push_back(t);
+      // ===== Augment =====
+      ++_time;
+      max_flow += Augment(meet);
 
-        // residual capacity = c_f(u,v) = cap(u,v) - flow(u,v)
-        flows[from][to].c_f = _graph[from][to_idx].capacity;
-        flows[to][from].c_f = 0;
+      // ===== Adopt =====
+      while(!_orphans.empty()) {
+        int v = _orphans.front();
+        _orphans.pop_front();
+        Adopt(v);
       }
     }
 
-    vector<int> mins(_graph.size(), 999999999);
-    vector<int> lasts(_graph.size(), -1);
-
-    for(;;) { // while a path has been found...
-      // ===== Find a path in the residual graph. =====
-
-      // Minimum number of moves to reach this vertex.
-      mins.assign(_graph.size(), 999999999);
-      lasts.assign(_graph.size(), -1);
-
-      // Make this a stack for depth-first
-      // Breadth-first search
-      queue<pair<int, int> > s; // <idx, last>
-      s.push(make_pair(source_idx, -1));
-      mins[source_idx] = 0;
+    return max_flow;
+  }
 
-      int idx, last;
-      while(!s.empty()){
-        pair<int,int> p = s.front();
-        s.pop();
+private:
+  enum { FREE, S_TREE, T_TREE };
+  // Special values of _parent.
+  enum { NO_PARENT = -1, TERMINAL = -2, ORPHAN = -3 };
+  enum { INF_DIST = 999999999 };
+
+  // Residual graph. Arcs of vertex v are [_first[v], _first[v+1]).
+  vector<int> _first;
+  vector<int> _to;
+  vector<int> _c_f; // residual capacity.
+  vector<int> _rev; // index of the reverse arc.
+
+  // Search trees.
+  vector<int> _tree;
+  // _parent[v] = arc from v to its parent.
+  vector<int> _parent;
+  // Time stamp and distance to the terminal, for choosing new parents.
+  vector<int> _ts;
+  vector<int> _dist;
+  int _time;
+  deque<int> _active;
+  deque<int> _orphans;
+
+  // Send flow along the path source -> ... -> meet -> ... -> sink.
+  // Saturated tree arcs create orphans.
+  int Augment(int meet) {
+    // Find c_f_p (min of all c_f in this path)
+    int c_f_p = _c_f[meet];
+    for(int v = _to[_rev[meet]]; _parent[v] != TERMINAL; v = _to[_parent[v]])
+      c_f_p = min(c_f_p, _c_f[_rev[_parent[v]]]);
+    for(int v = _to[meet]; _parent[v] != TERMINAL; v = _to[_parent[v]])
+      c_f_p = min(c_f_p, _c_f[_parent[v]]);
+
+    // send flow through
+    Push(meet, c_f_p);
+    for(int v = _to[_rev[meet]]; _parent[v] != TERMINAL; ) {
+      int a = _parent[v];
+      int next = _to[a];
+      Push(_rev[a], c_f_p);
+      if(_c_f[_rev[a]] == 0) {
+        _parent[v] = ORPHAN;
+        _orphans.push_back(v);
+      }
+      v = next;
+    }
+    for(int v = _to[meet]; _parent[v] != TERMINAL; ) {
+      int a = _parent[v];
+      int next = _to[a];
+      Push(a, c_f_p);
+      if(_c_f[a] == 0) {
+        _parent[v] = ORPHAN;
+        _orphans.push_back(v);
+      }
+      v = next;
+    }
+    return c_f_p;
+  }
 
-        idx = p.first;
-        last = p.second;
-        int cmin = mins[idx];
-        lasts[idx] = last;
+  void Push(int a, int f) {
+    _c_f[a] -= f;
+    _c_f[_rev[a]] += f;
+  }
 
-        if(idx == sink_idx){
-          // We found a path.
+  // Try to find a new parent for v in its own tree,
+  // otherwise v becomes free.
+  void Adopt(int v) {
+    const int t = _tree[v];
+    int best = NO_PARENT;
+    int best_dist = INF_DIST;
+
+    for(int a = _first[v]; a < _first[v + 1]; ++a) {
+      int q = _to[a];
+      if(_tree[q] != t) continue;
+      // q must be able to send flow to v (S), or get flow from v (T).
+      if((t == S_TREE ? _c_f[_rev[a]] : _c_f[a]) <= 0) continue;
+
+      // Check q is still connected to the terminal, and how far.
+      int d = 0;
+      int j = q;
+      for(;;) {
+        if(_ts[j] == _time) { d += _dist[j]; break; }
+        if(_parent[j] == TERMINAL) {
+          _ts[j] = _time;
+          _dist[j] = 1;
+          ++d;
           break;
         }
-
-        // try all edges
-        for(const edge &e : _graph[idx]) {
-          // Check the residual capacity.
-          // It must be positive.
-          // Lookup the flow.
-          if(mins[e.to] > cmin + 1 && flows[idx][e.to].c_f > 0){
-            // Try this edge.
-            s.push(make_pair(e.to, idx));
-            mins[e.to] = cmin + 1;
-          }
-        }
-        // try "backwards" edges.
-        // the residual path can go places the normal graph can't.
-        for(const edge &e : back_graph[idx]) {
-
-          if(mins[e.to] > cmin + 1 && flows[idx][e.to].c_f > 0){
-            // Try this edge.
-            s.push(make_pair(e.to, idx));
-            mins[e.to] = cmin + 1;
-          }
-        }
+        if(_parent[j] == ORPHAN) { d = INF_DIST; break; }
+        ++d;
+        j = _to[_parent[j]];
       }
+      if(d >= INF_DIST) continue;
 
-      if(idx != sink_idx)
-        break; // no path was found.
-
-      // Got a path.
-
-      // Find c_f_p (min of all c_f in this path)
-      int c_f_p = 999999999; // min of all c_f
-      idx = sink_idx;
-      for(;;){
-        last = lasts[idx];
-        if(last < 0) break;
-        c_f_p = min(c_f_p, flows[last][idx].c_f);
-        idx = last;
+      if(d < best_dist) {
+        best = a;
+        best_dist = d;
       }
-
-      max_flow += c_f_p;
-
-      // send flow through
-      idx = sink_idx;
-      for(;;){
-        last = lasts[idx];
-        if(last < 0) break;
-        flows[last][idx].flow += c_f_p;
-        flows[idx][last].flow -= c_f_p;
-
-        flows[last][idx].c_f -= c_f_p;
-        flows[idx][last].c_f += c_f_p;
-        idx = last;
+      // Mark the path from q so later searches stop early.
+      for(j = q; _ts[j] != _time; j = _to[_parent[j]]) {
+        _ts[j] = _time;
+        _dist[j] = d--;
       }
+    }
 
-      // loop and try to find another path...
+    if(best != NO_PARENT) {
+      _parent[v] = best;
+      _ts[v] = _time;
+      _dist[v] = best_dist + 1;
+      return;
     }
 
-    return max_flow;
-  }
-  // if you only want the maximum flow.
-  int MaxFlow(int source_idx, int sink_idx) {
-    map<int, map<int, flow_edge> > flows;
-    return MaxFlow(source_idx, sink_idx, flows);
+    // No parent found. Neighbors in the tree may be able to
+    // reach v's old subtree now, and v's children become orphans.
+    for(int a = _first[v]; a < _first[v + 1]; ++a) {
+      int q = _to[a];
+      if(_tree[q] != t) continue;
+      if((t == S_TREE ? _c_f[_rev[a]] : _c_f[a]) > 0)
+        _active.push_back(q);
+      if(_parent[q] >= 0 && _to[_parent[q]] == v) {
+        _parent[q] = ORPHAN;
+        _orphans.push_back(q);
+      }
+    }
+    _tree[v] = FREE;
+    _parent[v] = NO_PARENT;
   }
-
-private:
-  const vector<vector<edge> > &_graph;
 };
 //============================================================
 
@@ -186,6 +286,7 @@ public:
   const char* Solve(int x_max, int y_max,
                     const vector<pair<int, int> > &banks) {
 
+    PROFILE_PHASE("build");
     _x_max = x_max;
     _y_max = y_max;
 
@@ -260,9 +361,10 @@ public:
       _graph[SOURCE_IDX].push_back(MakeEdge(SOURCE_IDX, idx_to, 1));
     }
 
-    // We have made the graph, now run the FordFulkerson to find
+    // We have made the graph, now run the max flow to find
     // the flow out.
-    int max = FordFulkerson(_graph).MaxFlow(SOURCE_IDX, SINK_IDX);
+    PROFILE_PHASE("flow BoykovKolmogorov");
+    int max = BoykovKolmogorov(_graph).MaxFlow(SOURCE_IDX, SINK_IDX);
 //    cerr << "max = " << max << endl;
     if(max != banks.size())
       return NOT_POSSIBLE;
@@ -296,22 +398,45 @@ private:
 };
 //============================================================
 
+// Read one problem from cin and print the answer.
+void Solve()
+{
+  PROFILE_PHASE("parse");
+  int streets = 0, avenues = 0, banks = 0;
+  cin >> streets >> avenues >> banks;
+  if(!cin || banks < 0) return; // out of input.
+  vector<pair<int,int> > bank_locs(banks);
+  for(size_t k = 0;k < banks;++k)
+    // Problem input uses 1 as the start index.
+    cin >> bank_locs[k].first >> bank_locs[k].second;
+
+  // A bank off the grid has no vertex (GetVertIdx gives -1), so don't
+  // build a graph for it. The banks were all read, the next problem
+  // still starts in the right place.
+  bool ok = streets > 0 && avenues > 0
+      && (long long)streets * avenues <= INT_MAX / 2 - 1;
+  for(const pair<int,int> &b : bank_locs)
+    ok = ok && b.first >= 1 && b.first <= streets
+        && b.second >= 1 && b.second <= avenues;
+  if(!ok) {
+    cerr << "bad problem, grid " << streets << 'x' << avenues
+         << " or a bank outside it\n";
+    return;
+  }
+
+  const char *answer = Crimewave().Solve(streets, avenues, bank_locs);
+  PROFILE_PHASE("output");
+  cout << answer << endl;
+}
+
 int main()
 {
   // Get problem input from cin.
   int num_problems;
-  int streets, avenues, banks;
   cin >> num_problems;
 
-  for(size_t p = 0;p < num_problems; ++p){
-    cin >> streets >> avenues >> banks;
-    vector<pair<int,int> > bank_locs(banks);
-    for(size_t k = 0;k < banks;++k)
-      // Problem input uses 1 as the start index.
-      cin >> bank_locs[k].first >> bank_locs[k].second;
-
-    cout << Crimewave().Solve(streets, avenues, bank_locs) << endl;
-  }
+  for(size_t p = 0;p < num_problems; ++p)
+    Solve();
 
   // // For testing...
   // NAMES[-1] = "NONE";
@@ -322,7 +447,7 @@ int main()
   // NAMES[4] = "d";
   // NAMES[5] = "e";
   // NAMES[6] = "y";
-  // // Test FordFulkerson
+  // // Test BoykovKolmogorov
   // vector<vector<edge> > g(7);
   // int x = 0; // source
   // int a = 1;
@@ -339,7 +464,7 @@ int main()
   // g[c].push_back({y, 2});
   // g[d].push_back({e, 2});
   // g[e].push_back({y, 3});
-  // FordFulkerson f(g);
+  // BoykovKolmogorov f(g);
   // int max_flow = f.MaxFlow(x, y);
   // cout << "MAX_FLOW = " << max_flow << endl;
 }
@@ -8,6 +8,11 @@
 #include <stack>
 #include <map>
 #include <set>
+#ifdef PROFILE
+#include "profile.h"
+#else
+#define PROFILE_PHASE(name)
+#endif
 using namespace std;
 
 //============================================================
@@ -18,133 +23,104 @@ struct edge{
   int capacity;
 };
 
-struct flow_edge{
-  int flow;
-  int c_f;
-  flow_edge()
-      : flow(0), c_f(0){}
-};
-
 class FordFulkerson
 {
 public:
   FordFulkerson(const vector<vector<edge> > &graph)
-      : _graph(graph)
-  {}
+  {
+    // Build the residual graph.
+    // Arcs for a vertex are stored together, first its edges from
+    // graph (in the same order), then the reverse arcs of the edges
+    // coming in, with zero capacity.
+    // So edge graph[from][k] is arc _first[from] + k.
+    const int n = graph.size();
+    _first.assign(n + 1, 0);
+    for(int from = 0;from < n; ++from)
+      for(const edge &e : graph[from]) {
+        ++_first[from + 1];
+        ++_first[e.to + 1];
+      }
+    for(int v = 0;v < n; ++v)
+      _first[v + 1] += _first[v];
+
+    _to.resize(_first[n]);
+    _c_f.resize(_first[n]);
+    _rev.resize(_first[n]);
+    vector<int> back_pos(n);
+    for(int v = 0;v < n; ++v)
+      back_pos[v] = _first[v] + graph[v].size();
+    for(int from = 0;from < n; ++from)
+      for(size_t k = 0;k < graph[from].size(); ++k) {
+        const edge &e = graph[from][k];
+        int a = _first[from] + k;
+        int b = back_pos[e.to]++;
+        // residual capacity = c_f(u,v) = cap(u,v) - flow(u,v)
+        _to[a] = e.to;  _c_f[a] = e.capacity; _rev[a] = b;
+        _to[b] = from;  _c_f[b] = 0;          _rev[b] = a;
+      }
+  }
 
   /*
     INPUT: source and sink indices.
-    OUTPUT: flow in/out for each vertex.
     returns max flow.
-    flows should be empty. It will return the flows for each edge.
   */
-  int MaxFlow(
-    int source_idx, int sink_idx,
-    map<int, map<int, flow_edge> >  &flows)
+  int MaxFlow(int source_idx, int sink_idx)
   {
+    const int n = _first.size() - 1;
     int max_flow = 0;
 
-    // keep track of "backwards" edges for the residual graph.
-    vector<vector<edge> > back_graph(_graph.size());
-
-    // initialize flow
-    for(int from = 0;from < _graph.size(); ++from) {
-      for(int to_idx = 0; to_idx < _graph[from].size(); ++to_idx){
-
-        int to = _graph[from][to_idx].to;
-
-        // push an edge going backwards, with zero capacity.
-        edge t = {from,0};
-        back_graph[to].push_back(t);
-
-        // residual capacity = c_f(u,v) = cap(u,v) - flow(u,v)
-        flows[from][to].c_f = _graph[from][to_idx].capacity;
-        //        flows[to][from].c_f = 0;
-      }
-    }
-
-    vector<int> mins;
-    vector<int> lasts;
+    // lasts[v] = arc used to get to v.
+    vector<int> lasts(n);
+    vector<int> s(n); // BFS queue, each vertex is pushed at most once.
+    // Minimum number of moves to reach this vertex.
+    vector<int> mins(n);
 
     for(;;) { // while a path has been found...
       // ===== Find a path in the residual graph. =====
 
-      // Minimum number of moves to reach this vertex.
-      mins.assign(_graph.size(), 999999999);
-      lasts.assign(_graph.size(), -1);
+      mins.assign(n, INF);
 
-      // Make this a stack for depth-first
       // Breadth-first search
-      queue<pair<int, int> > s; // <idx, last>
-      s.push(make_pair(source_idx, -1));
+      int head = 0, tail = 0;
+      s[tail++] = source_idx;
       mins[source_idx] = 0;
+      lasts[source_idx] = -1;
 
-      int idx, last;
-      while(!s.empty()){
-        pair<int,int> p = s.front();
-        s.pop();
-
-        idx = p.first;
-        last = p.second;
+      while(head < tail && mins[sink_idx] == INF){
+        int idx = s[head++];
         int cmin = mins[idx];
-        lasts[idx] = last;
-
-        if(idx == sink_idx){
-          // We found a path.
-          break;
-        }
 
-        // try all edges
-        for(const edge &e : _graph[idx]) {
+        // try all arcs, the residual path can go backwards
+        // where the normal graph can't.
+        for(int a = _first[idx]; a < _first[idx + 1]; ++a) {
           // Check the residual capacity.
           // It must be positive.
-          // Lookup the flow.
-          if(mins[e.to] > cmin + 1 && flows[idx][e.to].c_f > 0){
-            // Try this edge.
-            s.push(make_pair(e.to, idx));
-            mins[e.to] = cmin + 1;
-          }
-        }
-        // try "backwards" edges.
-        // the residual path can go places the normal graph can't.
-        for(const edge &e : back_graph[idx]) {
-
-          if(mins[e.to] > cmin + 1 && flows[idx][e.to].c_f > 0){
+          int to = _to[a];
+          if(mins[to] == INF && _c_f[a] > 0){
             // Try this edge.
-            s.push(make_pair(e.to, idx));
-            mins[e.to] = cmin + 1;
+            mins[to] = cmin + 1;
+            lasts[to] = a;
+            s[tail++] = to;
           }
         }
       }
 
-      if(idx != sink_idx)
+      if(mins[sink_idx] == INF)
         break; // no path was found.
 
       // Got a path.
 
       // Find c_f_p (min of all c_f in this path)
-      int c_f_p = 999999999; // min of all c_f
-      idx = sink_idx;
-      for(;;){
-        last = lasts[idx];
-        if(last < 0) break;
-        c_f_p = min(c_f_p, flows[last][idx].c_f);
-        idx = last;
-      }
+      int c_f_p = INF; // min of all c_f
+      for(int idx = sink_idx; lasts[idx] >= 0; idx = _to[_rev[lasts[idx]]])
+        c_f_p = min(c_f_p, _c_f[lasts[idx]]);
 
       max_flow += c_f_p;
 
       // send flow through
-      idx = sink_idx;
-      for(;;){
-        last = lasts[idx];
-        if(last < 0) break;
-        flows[last][idx].flow += c_f_p;
-        flows[idx][last].flow -= c_f_p;
-
-        flows[last][idx].c_f -= c_f_p;
-        flows[idx][last].c_f += c_f_p;
-        idx = last;
+      for(int idx = sink_idx; lasts[idx] >= 0; idx = _to[_rev[lasts[idx]]]){
+        _c_f[lasts[idx]] -= c_f_p;
+        _c_f[_rev[lasts[idx]]] += c_f_p;
       }
 
       // loop and try to find another path...
@@ -152,28 +128,45 @@ public:
 
     return max_flow;
   }
-  // if you only want the maximum flow.
-  int MaxFlow(int source_idx, int sink_idx) {
-    map<int, map<int, flow_edge> > flows;
-    return MaxFlow(source_idx, sink_idx, flows);
-  }
 
 private:
-  const vector<vector<edge> > &_graph;
+  enum { INF = 999999999 };
+
+  // Residual graph. Arcs of vertex v are [_first[v], _first[v+1]).
+  vector<int> _first;
+  vector<int> _to;
+  vector<int> _c_f; // residual capacity.
+  vector<int> _rev; // index of the reverse arc.
 };
 //============================================================
 
+// Read a count from cin.
+// false, with a message on cerr, if it is missing or negative.
+bool ReadCount(int &count, const char *what)
+{
+  count = 0;
+  cin >> count;
+  if(!cin || count < 0) {
+    cerr << "bad " << what << " count\n";
+    return false;
+  }
+  return true;
+}
+
 void Solve()
 {
+  PROFILE_PHASE("parse");
   // Read input.
+  // A bad count leaves no way to find the rest of the problem,
+  // so give up on it before sizing anything with it.
   int num_receptacles;
-  cin >> num_receptacles;
+  if(!ReadCount(num_receptacles, "receptacle")) return;
   vector<string> receptacles(num_receptacles);
   for(int k = 0;k < num_receptacles;++k)
     cin >> receptacles[k];
 
   int num_devices;
-  cin >> num_devices;
+  if(!ReadCount(num_devices, "device")) return;
   vector<pair<string, string> > devs(num_devices);
   for(int k = 0;k < num_devices; ++k){
     string d, r;
@@ -182,7 +175,7 @@ void Solve()
   }
 
   int num_adapter_avail;
-  cin >> num_adapter_avail;
+  if(!ReadCount(num_adapter_avail, "adapter")) return;
   vector<pair<string, string> > adapter;
   map<string,string> have;
   for(int k = 0;k < num_adapter_avail; ++k) {
@@ -217,6 +210,7 @@ void Solve()
   // cerr << "num_devices = " << num_devices << '\n';
   // cerr << "num_adapter = " << num_adapter_avail << '\n';
 
+  PROFILE_PHASE("build");
   // Setup the graph.
   /*
     0 source
@@ -289,8 +283,11 @@ void Solve()
   //   cerr << '\n';
   // }
 
-  FordFulkerson f(graph);
-  cout << num_devices - f.MaxFlow(SOURCE, SINK) << "\n\n";
+  PROFILE_PHASE("flow FordFulkerson");
+  int max_flow = FordFulkerson(graph).MaxFlow(SOURCE, SINK);
+
+  PROFILE_PHASE("output");
+  cout << num_devices - max_flow << "\n\n";
 }
 
 int main()
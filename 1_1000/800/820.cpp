@@ -4,6 +4,12 @@
 #include <vector>
 #include <map>
 #include <queue>
+#include <cstdint>
+#ifdef PROFILE
+#include "profile.h"
+#else
+#define PROFILE_PHASE(name)
+#endif
 
 using namespace std;
 
@@ -160,59 +166,224 @@ private:
 };
 //============================================================
 
+//============================================================
+// DenseFordFulkerson
+//============================================================
+/*
+  Adjacency matrix version of the above, for small graphs.
+  Keeps a residual capacity matrix, plus a bit mask for each vertex
+  of which neighbors still have positive residual capacity.
+  The BFS can then expand a vertex with a few word operations:
+    next = residual_mask[v] & ~visited
+  instead of walking edge lists and doing map lookups.
+*/
+class DenseFordFulkerson
+{
+public:
+  // Use this class when the graph has at most this many vertices.
+  static const int MAX_VERTS = 256;
+
+  DenseFordFulkerson(int num_verts)
+      : _n(num_verts),
+        _words((num_verts + 63) / 64),
+        _c_f(num_verts * num_verts, 0),
+        _mask(num_verts * _words, 0)
+  {}
+
+  // Add capacity from -> to. Parallel edges are merged.
+  void AddEdge(int from, int to, int capacity) {
+    if(from == to || capacity <= 0) return;
+    _c_f[from * _n + to] += capacity;
+    SetBit(from, to);
+  }
+
+  // returns max flow.
+  int MaxFlow(int source_idx, int sink_idx) {
+    int max_flow = 0;
+
+    vector<int> lasts(_n);
+    vector<int> s(_n); // BFS queue, each vertex is pushed at most once.
+    vector<uint64_t> visited(_words);
+
+    for(;;) { // while a path has been found...
+      // ===== Find a path in the residual graph. =====
+      visited.assign(_words, 0);
+      visited[source_idx / 64] |= uint64_t(1) << (source_idx % 64);
+      lasts[source_idx] = -1;
+
+      int head = 0, tail = 0;
+      s[tail++] = source_idx;
+      bool found = false;
+      while(head < tail && !found){
+        int idx = s[head++];
+        const uint64_t *m = &_mask[idx * _words];
+
+        for(int w = 0; w < _words && !found; ++w) {
+          // neighbors with positive residual capacity, not yet seen.
+          uint64_t next = m[w] & ~visited[w];
+          visited[w] |= next;
+          while(next){
+            int to = w * 64 + __builtin_ctzll(next);
+            next &= next - 1;
+            lasts[to] = idx;
+            if(to == sink_idx){
+              found = true;
+              break;
+            }
+            s[tail++] = to;
+          }
+        }
+      }
+
+      if(!found)
+        break; // no path was found.
+
+      // Find c_f_p (min of all c_f in this path)
+      int c_f_p = 999999999;
+      for(int idx = sink_idx; lasts[idx] >= 0; idx = lasts[idx])
+        c_f_p = min(c_f_p, _c_f[lasts[idx] * _n + idx]);
+
+      max_flow += c_f_p;
+
+      // send flow through
+      for(int idx = sink_idx; lasts[idx] >= 0; idx = lasts[idx]){
+        int last = lasts[idx];
+        if((_c_f[last * _n + idx] -= c_f_p) == 0)
+          ClearBit(last, idx);
+        if((_c_f[idx * _n + last] += c_f_p) == c_f_p)
+          SetBit(idx, last);
+      }
+
+      // loop and try to find another path...
+    }
+
+    return max_flow;
+  }
+
+private:
+  int _n;
+  int _words; // 64 bit words per mask.
+  // _c_f[from * _n + to] = residual capacity.
+  vector<int> _c_f;
+  // _mask[from * _words + to/64] bit (to%64) set when c_f(from,to) > 0.
+  vector<uint64_t> _mask;
+
+  void SetBit(int from, int to) {
+    _mask[from * _words + to / 64] |= uint64_t(1) << (to % 64);
+  }
+  void ClearBit(int from, int to) {
+    _mask[from * _words + to / 64] &= ~(uint64_t(1) << (to % 64));
+  }
+};
+//============================================================
+
 bool Solve(int network)
 {
+  PROFILE_PHASE("parse");
   int num_nodes;
   cin >> num_nodes; // [2 to 100]
   if(num_nodes == 0) return false; // terminated input
 
-  int source, sink, total_conn;
+  int source = 0, sink = 0, total_conn = 0;
   cin >> source >> sink >> total_conn;
+  if(!cin || num_nodes < 0 || total_conn < 0) {
+    cerr << "bad network header\n";
+    return false; // can't tell where the next network starts.
+  }
+  // Node ids go straight into the arrays, one out of [1, num_nodes]
+  // would index outside them. The network is still read to the end,
+  // then skipped.
+  auto in_range = [num_nodes](int id) { return id >= 1 && id <= num_nodes; };
+  bool ok = in_range(source) && in_range(sink);
+
+  int max_flow;
+  if(num_nodes <= DenseFordFulkerson::MAX_VERTS) {
+    // Small network, use the matrix.
+    // The connections go straight in: an undirected connection is
+    // just an edge each way, and AddEdge merges parallel ones.
+    DenseFordFulkerson f(num_nodes);
+    for(int k = 0 ; k < total_conn; ++k){
+      int a, b, bandwidth;
+      cin >> a >> b >> bandwidth;
+      if(!in_range(a) || !in_range(b)) { ok = false; continue; }
+      f.AddEdge(a-1, b-1, bandwidth);
+      f.AddEdge(b-1, a-1, bandwidth);
+    }
+    if(!ok) {
+      cerr << "bad node id in network " << network << '\n';
+      return true;
+    }
+    PROFILE_PHASE("flow DenseFordFulkerson");
+    max_flow = f.MaxFlow(source-1, sink-1);
+  }else{
+    // Read the connections. Parallel connections between the same
+    // two nodes (in either direction) are merged into one, since the
+    // bandwidth is shared both ways.
+    // conns[(a,b)] = total bandwidth, a < b. (zero based)
+    map<pair<int, int>, int> conns;
+    for(int k = 0 ; k < total_conn; ++k){
+      int a, b, bandwidth;
+      cin >> a >> b >> bandwidth;
+      if(!in_range(a) || !in_range(b)) { ok = false; continue; }
+      if(a == b) continue; // a loop can't carry any flow.
+      if(a > b) swap(a,b);
+      conns[make_pair(a-1, b-1)] += bandwidth;
+    }
 
-  // indexing into graph will be (node id) - 1. (zero based)
-  vector<vector<edge> > graph(num_nodes);
-
-  for(int k = 0 ; k < total_conn; ++k){
-
-    int a, b, bandwidth;
-    cin >> a >> b >> bandwidth;
-
-    // Every edge will have an extra two vertices
-    // to combine flow between 'a' and 'b'
-    // since you can go from a to b, and from b to a.
-    graph.push_back(vector<edge>()); // c
-    int c = graph.size();
-    int d = graph.size()+1;
+    if(!ok) {
+      cerr << "bad node id in network " << network << '\n';
+      return true;
+    }
 
-    edge e = {d-1,bandwidth}; // add edge c -> d
-    graph[c-1].push_back(e);
-    graph.push_back(vector<edge>()); // d
+    PROFILE_PHASE("build");
+    // indexing into graph will be (node id) - 1. (zero based)
+    vector<vector<edge> > graph(num_nodes);
+
+    for(const auto &conn : conns){
+      int a = conn.first.first + 1;
+      int b = conn.first.second + 1;
+      int bandwidth = conn.second;
+
+      // Every edge will have an extra two vertices
+      // to combine flow between 'a' and 'b'
+      // since you can go from a to b, and from b to a.
+      graph.push_back(vector<edge>()); // c
+      int c = graph.size();
+      int d = graph.size()+1;
+
+      edge e = {d-1,bandwidth}; // add edge c -> d
+      graph[c-1].push_back(e);
+      graph.push_back(vector<edge>()); // d
+
+      // add edge a -> c,  b -> c
+      e = {c-1, bandwidth};
+      graph[a-1].push_back(e);
+      graph[b-1].push_back(e);
+
+      // d -> a
+      e = {a-1, bandwidth};
+      graph[d-1].push_back(e);
+      // d-> b
+      e = {b-1, bandwidth};
+      graph[d-1].push_back(e);
+    }
 
-    // add edge a -> c,  b -> c
-    e = {c-1, bandwidth};
-    graph[a-1].push_back(e);
-    graph[b-1].push_back(e);
+    // // Debug, output graph.
+    // for(size_t k = 0;k < graph.size(); ++k){
+    //   cerr << k << ":";
+    //   for(size_t j = 0;j < graph[k].size(); ++j)
+    //     cerr << ' ' << "(" << graph[k][j].to << "/" << graph[k][j].capacity << ")";
+    //   cerr << '\n';
+    // }
 
-    // d -> a
-    e = {a-1, bandwidth};
-    graph[d-1].push_back(e);
-    // d-> b
-    e = {b-1, bandwidth};
-    graph[d-1].push_back(e);
+    PROFILE_PHASE("flow FordFulkerson");
+    max_flow = FordFulkerson(graph).MaxFlow(source-1,sink-1);
   }
 
-  // // Debug, output graph.
-  // for(size_t k = 0;k < graph.size(); ++k){
-  //   cerr << k << ":";
-  //   for(size_t j = 0;j < graph[k].size(); ++j)
-  //     cerr << ' ' << "(" << graph[k][j].to << "/" << graph[k][j].capacity << ")";
-  //   cerr << '\n';
-  // }
-
   // Output max bandwidth, according to the format in
   //  the problem statement.
+  PROFILE_PHASE("output");
   cout << "Network " << network << '\n';
-  int max_flow = FordFulkerson(graph).MaxFlow(source-1,sink-1);
   cout << "The bandwidth is " << max_flow << ".\n";
   cout << '\n'; // print a blank line after each test case.
   return true;
@@ -0,0 +1,71 @@
+#!/usr/bin/env python
+# Writes a benchmark input for one problem to stdout.
+#   python bench/gen_inputs.py <problem>
+# The inputs are random but always the same (fixed seed), and stay
+# inside the limits of the problem statements.
+# Used by 'scons pgo=1' to train and check the PGO builds.
+
+import random,sys
+
+def gen_563(rnd, out):
+    # Crimewave: s, a <= 50.
+    tests = 200
+    out.append('%d' % tests)
+    for t in range(tests):
+        s = rnd.randint(1, 50)
+        a = rnd.randint(1, 50)
+        cells = [(x, y) for x in range(1, s + 1) for y in range(1, a + 1)]
+        b = rnd.randint(1, max(1, len(cells) // rnd.choice([2, 4, 10])))
+        banks = rnd.sample(cells, b)
+        out.append('%d %d %d' % (s, a, b))
+        for c in banks:
+            out.append('%d %d' % c)
+
+def gen_753(rnd, out):
+    # A Plug for UNIX: up to 100 receptacles, devices and adapters.
+    tests = 100
+    out.append('%d' % tests)
+    for t in range(tests):
+        types = ['T%d' % k for k in range(rnd.randint(5, 60))]
+        out.append('')
+        n = rnd.randint(1, 100)
+        out.append('%d' % n)
+        for k in range(n):
+            out.append(rnd.choice(types))
+        m = rnd.randint(1, 100)
+        out.append('%d' % m)
+        for k in range(m):
+            out.append('dev%d %s' % (k, rnd.choice(types)))
+        k = rnd.randint(0, 100)
+        out.append('%d' % k)
+        for j in range(k):
+            out.append('%s %s' % (rnd.choice(types), rnd.choice(types)))
+
+def gen_820(rnd, out):
+    # Internet Bandwidth: n <= 100, many parallel connections.
+    networks = 300
+    for t in range(networks):
+        n = rnd.randint(2, 100)
+        s, d = rnd.sample(range(1, n + 1), 2)
+        c = rnd.randint(0, n * 10)
+        out.append('%d' % n)
+        out.append('%d %d %d' % (s, d, c))
+        for k in range(c):
+            a, b = rnd.sample(range(1, n + 1), 2)
+            out.append('%d %d %d' % (a, b, rnd.randint(1, 1000)))
+    out.append('0')
+
+GENERATORS = {
+    '563' : gen_563,
+    '753' : gen_753,
+    '820' : gen_820,
+}
+
+if __name__ == '__main__':
+    if len(sys.argv) != 2 or sys.argv[1] not in GENERATORS:
+        sys.stderr.write('usage: %s <%s>\n'
+                         % (sys.argv[0], '|'.join(sorted(GENERATORS))))
+        sys.exit(1)
+    out = []
+    GENERATORS[sys.argv[1]](random.Random(int(sys.argv[1])), out)
+    sys.stdout.write('\n'.join(out) + '\n')
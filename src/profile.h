@@ -0,0 +1,429 @@
+// Per phase profiling for the solutions.
+//
+// A solution marks where each phase starts:
+//   PROFILE_PHASE("parse");
+//   ...
+//   PROFILE_PHASE("flow BoykovKolmogorov");
+// Everything until the next PROFILE_PHASE is counted for that phase.
+// A report for the whole run is printed on cerr when the program exits.
+//
+// Only used when built with 'scons perf=1' (defines PROFILE and
+// PROFILE_PERF) or 'scons alloc=1' (PROFILE and PROFILE_ALLOC), or
+// both. Solutions include this with:
+//   #ifdef PROFILE
+//   #include "profile.h"
+//   #else
+//   #define PROFILE_PHASE(name)
+//   #endif
+// so they still build as a single file without it.
+//
+// PROFILE_PERF: hardware counters from perf_event_open, cycles,
+// instructions, L1 data / last level cache misses, branch misses and
+// page faults. Counters the kernel won't give us (containers, VMs,
+// perf_event_paranoid) are left out, wall time is always reported.
+// Threads are counted with the main one. When the counters have to
+// share the PMU, the values are scaled estimates, like perf stat's.
+//
+// PROFILE_ALLOC: replaces the global operator new / delete to count
+// allocations, frees, bytes asked for, and the peak of live heap
+// memory (as malloc_usable_size sees it) during each phase.
+// An allocation is counted in the phase it was made in. Its free is
+// counted in that same phase too, whenever it happens: a map filled
+// while parsing and destroyed at the end of Solve() shows up as frees
+// in "parse", not in "output". For this every block gets a small
+// header with the phase number, the peak live memory does not include
+// the headers. Only include this once per program, it defines
+// operator new.
+
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <map>
+#include <chrono>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <cerrno>
+#include <cstdio>
+
+#ifdef PROFILE_ALLOC
+#include <atomic>
+#include <new>
+#include <cstddef>
+#include <cstdlib>
+#include <malloc.h>
+#endif
+
+#ifdef PROFILE_PERF
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace profile {
+
+#ifdef PROFILE_ALLOC
+//============================================================
+// AllocStats
+//============================================================
+// Updated by operator new / delete below, from any thread.
+struct AllocStats {
+  // Phase k is counted in slot k + 1. Slot 0 is shared by blocks
+  // allocated before the first phase, and phases past MAX_PHASES - 1.
+  enum { MAX_PHASES = 64 };
+  // In front of every block, keeps the block aligned.
+  enum { HEADER = alignof(std::max_align_t) };
+
+  std::atomic<uint64_t> allocs;
+  std::atomic<uint64_t> bytes; // asked for.
+  std::atomic<int64_t> live; // usable size of blocks not freed yet.
+  // highest 'live' since the current phase started.
+  std::atomic<int64_t> phase_peak;
+  // Slot of the current phase, new blocks are marked with it.
+  std::atomic<int> slot;
+  // slot_frees[k] = frees of blocks allocated while slot was k.
+  std::atomic<uint64_t> slot_frees[MAX_PHASES];
+
+  static AllocStats& Get() {
+    // constant initialized, so it works before main and after exit.
+    static AllocStats stats;
+    return stats;
+  }
+
+  static int Slot(int phase) {
+    return phase + 1 < MAX_PHASES ? phase + 1 : 0;
+  }
+
+  // block is what malloc returned, n bytes were asked for.
+  // returns the pointer for the caller, after the header.
+  void* Alloc(void *block, size_t n) {
+    *(int*)block = slot.load(std::memory_order_relaxed);
+    allocs.fetch_add(1, std::memory_order_relaxed);
+    bytes.fetch_add(n, std::memory_order_relaxed);
+    int64_t size = malloc_usable_size(block) - HEADER;
+    int64_t now = live.fetch_add(size, std::memory_order_relaxed) + size;
+    int64_t peak = phase_peak.load(std::memory_order_relaxed);
+    while(now > peak
+          && !phase_peak.compare_exchange_weak(peak, now,
+                                               std::memory_order_relaxed));
+    return (char*)block + HEADER;
+  }
+
+  // p is what Alloc returned. returns the block to give to free.
+  void* Free(void *p) {
+    void *block = (char*)p - HEADER;
+    slot_frees[*(int*)block].fetch_add(1, std::memory_order_relaxed);
+    live.fetch_sub(malloc_usable_size(block) - HEADER,
+                   std::memory_order_relaxed);
+    return block;
+  }
+};
+//============================================================
+#endif
+
+#ifdef PROFILE_PERF
+//============================================================
+// PerfCounters
+//============================================================
+class PerfCounters
+{
+public:
+  struct Counter {
+    const char *name;
+    uint32_t type;
+    uint64_t config;
+  };
+
+  enum { NUM_COUNTERS = 6 };
+
+  static const Counter* Counters() {
+    static const Counter counters[NUM_COUNTERS] = {
+      {"cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+      {"instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+      {"L1d misses", PERF_TYPE_HW_CACHE,
+       PERF_COUNT_HW_CACHE_L1D
+       | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+       | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+      {"LLC misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+      {"branch misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+      {"page faults", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS},
+    };
+    return counters;
+  }
+
+  PerfCounters() {
+    for(int k = 0;k < NUM_COUNTERS; ++k) {
+      perf_event_attr attr;
+      memset(&attr, 0, sizeof(attr));
+      attr.size = sizeof(attr);
+      attr.type = Counters()[k].type;
+      attr.config = Counters()[k].config;
+      // user space only, that is all we are allowed in most places.
+      attr.exclude_kernel = 1;
+      attr.exclude_hv = 1;
+      // threads started later are counted too. The kernel adds a
+      // thread's counts in when it exits.
+      attr.inherit = 1;
+      // more counters than the PMU has are time shared, so also read
+      // how long each one was enabled and how long it really ran.
+      attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED
+          | PERF_FORMAT_TOTAL_TIME_RUNNING;
+      _fd[k] = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+      if(_fd[k] < 0)
+        _error[k] = strerror(errno);
+    }
+  }
+  ~PerfCounters() {
+    for(int k = 0;k < NUM_COUNTERS; ++k)
+      if(_fd[k] >= 0)
+        close(_fd[k]);
+  }
+
+  bool Available(int k) const { return _fd[k] >= 0; }
+  const std::string& Error(int k) const { return _error[k]; }
+
+  // Current value of every counter, 0 if it is not available.
+  // A counter that only ran part of the time it was enabled is scaled
+  // up to an estimate for all of it, the way perf stat does.
+  void Read(uint64_t *values) const {
+    for(int k = 0;k < NUM_COUNTERS; ++k) {
+      values[k] = 0;
+      uint64_t r[3]; // value, time enabled, time running.
+      if(_fd[k] < 0 || read(_fd[k], r, sizeof(r)) != sizeof(r)
+         || r[2] == 0)
+        continue;
+      values[k] = r[1] == r[2] ? r[0]
+          : uint64_t((double)r[0] * r[1] / r[2]);
+    }
+  }
+
+private:
+  int _fd[NUM_COUNTERS];
+  std::string _error[NUM_COUNTERS];
+
+  PerfCounters(const PerfCounters&);
+  void operator=(const PerfCounters&);
+};
+//============================================================
+#endif
+
+//============================================================
+// Profiler
+//============================================================
+class Profiler
+{
+public:
+  static Profiler& Get() {
+    static Profiler p;
+    return p;
+  }
+
+  // End the current phase and start counting for 'name'.
+  void Phase(const char *name) {
+#ifdef PROFILE_ALLOC
+    // Our own blocks aren't in any phase.
+    AllocStats::Get().slot = 0;
+#endif
+    Sample now;
+    Take(now);
+    if(_current >= 0)
+      Add(_phases[_current], now);
+
+    auto i = _index.find(name);
+    if(i == _index.end()) {
+      i = _index.insert(std::make_pair(std::string(name), int(_phases.size()))).first;
+      _phases.push_back(Totals());
+      _phases.back().name = name;
+    }
+    _current = i->second;
+    ++_phases[_current].calls;
+
+    // Start after our own bookkeeping, so it isn't counted.
+    Take(_last);
+#ifdef PROFILE_ALLOC
+    AllocStats &a = AllocStats::Get();
+    a.phase_peak = a.live.load();
+    a.slot = AllocStats::Slot(_current);
+#endif
+  }
+
+  ~Profiler() {
+    if(_current >= 0) {
+      Sample now;
+      Take(now);
+      Add(_phases[_current], now);
+    }
+    Report();
+  }
+
+private:
+#ifdef PROFILE_PERF
+  enum { NUM_COUNTERS = PerfCounters::NUM_COUNTERS };
+#else
+  enum { NUM_COUNTERS = 0 };
+#endif
+
+  struct Sample {
+    std::chrono::steady_clock::time_point time;
+    uint64_t counts[NUM_COUNTERS + 1];
+    uint64_t allocs, bytes;
+  };
+  struct Totals {
+    std::string name;
+    long long calls;
+    double seconds;
+    uint64_t counts[NUM_COUNTERS + 1];
+    uint64_t allocs, bytes;
+    int64_t peak_live;
+    Totals()
+        : calls(0), seconds(0),
+          allocs(0), bytes(0), peak_live(0) {
+      memset(counts, 0, sizeof(counts));
+    }
+  };
+
+#ifdef PROFILE_PERF
+  PerfCounters _perf;
+#endif
+  std::vector<Totals> _phases;
+  std::map<std::string, int> _index;
+  int _current;
+  Sample _last;
+
+  Profiler()
+      : _current(-1)
+  {}
+
+  void Take(Sample &s) {
+    s.time = std::chrono::steady_clock::now();
+#ifdef PROFILE_PERF
+    _perf.Read(s.counts);
+#endif
+#ifdef PROFILE_ALLOC
+    AllocStats &a = AllocStats::Get();
+    s.allocs = a.allocs;
+    s.bytes = a.bytes;
+#else
+    s.allocs = s.bytes = 0;
+#endif
+  }
+
+  void Add(Totals &t, const Sample &now) {
+    t.seconds += std::chrono::duration<double>(now.time - _last.time).count();
+    for(int k = 0;k < NUM_COUNTERS; ++k)
+      t.counts[k] += now.counts[k] - _last.counts[k];
+    t.allocs += now.allocs - _last.allocs;
+    t.bytes += now.bytes - _last.bytes;
+#ifdef PROFILE_ALLOC
+    t.peak_live = std::max<int64_t>(t.peak_live, AllocStats::Get().phase_peak);
+#endif
+  }
+
+  void Report() {
+#ifdef PROFILE_ALLOC
+    // Frees still going on now (our own report strings) aren't wanted.
+    uint64_t frees[AllocStats::MAX_PHASES];
+    for(int k = 0;k < AllocStats::MAX_PHASES; ++k)
+      frees[k] = AllocStats::Get().slot_frees[k];
+#endif
+    std::ostream &out = std::cerr;
+    out << "== profile: " << program_invocation_short_name << " ==\n";
+#ifdef PROFILE_PERF
+    for(int k = 0;k < NUM_COUNTERS; ++k)
+      if(!_perf.Available(k))
+        out << PerfCounters::Counters()[k].name << ": not available ("
+            << _perf.Error(k) << ")\n";
+#endif
+    out << std::left << std::setw(28) << "phase" << std::right
+        << std::setw(8) << "calls" << std::setw(12) << "ms";
+#ifdef PROFILE_PERF
+    for(int k = 0;k < NUM_COUNTERS; ++k)
+      if(_perf.Available(k))
+        out << std::setw(16) << PerfCounters::Counters()[k].name;
+#endif
+#ifdef PROFILE_ALLOC
+    out << std::setw(12) << "allocs" << std::setw(12) << "frees"
+        << std::setw(16) << "bytes" << std::setw(16) << "peak live";
+#endif
+    out << '\n';
+
+    for(size_t k = 0;k < _phases.size(); ++k) {
+      const Totals &t = _phases[k];
+      out << std::left << std::setw(28) << t.name << std::right
+          << std::setw(8) << t.calls
+          << std::setw(12) << std::fixed << std::setprecision(3)
+          << t.seconds * 1000;
+#ifdef PROFILE_PERF
+      for(int k = 0;k < NUM_COUNTERS; ++k)
+        if(_perf.Available(k))
+          out << std::setw(16) << t.counts[k];
+#endif
+#ifdef PROFILE_ALLOC
+      // slot 0 is shared, see AllocStats.
+      out << std::setw(12) << t.allocs;
+      int slot = AllocStats::Slot(k);
+      if(slot > 0)
+        out << std::setw(12) << frees[slot];
+      else
+        out << std::setw(12) << "?";
+      out << std::setw(16) << t.bytes << std::setw(16) << t.peak_live;
+#endif
+      out << '\n';
+    }
+  }
+
+  Profiler(const Profiler&);
+  void operator=(const Profiler&);
+};
+//============================================================
+
+} // namespace profile
+
+#ifdef PROFILE_ALLOC
+// Blocks have a header in front, so every form has to be ours, even
+// the ones the standard library would forward here anyway. (other
+// runtimes, like ASan's, have their own sized delete)
+// Not inlined, or gcc sees free() on a pointer from new and warns.
+__attribute__((noinline)) void* operator new(size_t n)
+{
+  void *block = malloc(profile::AllocStats::HEADER + n);
+  if(!block) throw std::bad_alloc();
+  return profile::AllocStats::Get().Alloc(block, n);
+}
+
+__attribute__((noinline)) void operator delete(void *p) noexcept
+{
+  if(!p) return;
+  free(profile::AllocStats::Get().Free(p));
+}
+
+void* operator new[](size_t n) { return operator new(n); }
+void operator delete[](void *p) noexcept { operator delete(p); }
+void operator delete(void *p, size_t) noexcept { operator delete(p); }
+void operator delete[](void *p, size_t) noexcept { operator delete(p); }
+
+void* operator new(size_t n, const std::nothrow_t&) noexcept
+{
+  try { return operator new(n); } catch(...) { return 0; }
+}
+void* operator new[](size_t n, const std::nothrow_t&) noexcept
+{
+  try { return operator new(n); } catch(...) { return 0; }
+}
+void operator delete(void *p, const std::nothrow_t&) noexcept
+{
+  operator delete(p);
+}
+void operator delete[](void *p, const std::nothrow_t&) noexcept
+{
+  operator delete(p);
+}
+#endif
+
+#define PROFILE_PHASE(name) ::profile::Profiler::Get().Phase(name)
+
+#endif
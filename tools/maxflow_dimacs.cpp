@@ -0,0 +1,926 @@
+// Max flow for graphs in DIMACS format, not UVa input.
+//
+// Usage:
+//   maxflow_dimacs graph.max             solve a DIMACS max flow file
+//   maxflow_dimacs graph.max -o g.csr    also save a binary CSR copy
+//   maxflow_dimacs g.csr                 solve a saved binary CSR file
+//   maxflow_dimacs -r graph.max ...      renumber the nodes first
+//   maxflow_dimacs -s graph.max ...      shrink the graph first
+//   maxflow_dimacs -f graph.max ...      also print the flow on each arc
+//   maxflow_dimacs -c graph.max ...      also print the min cut
+//
+// DIMACS format:
+//   c comment
+//   p max <nodes> <arcs>
+//   n <id> s        source
+//   n <id> t        sink
+//   a <from> <to> <capacity>
+// Node ids start at 1.
+//
+// The binary file is the residual graph exactly as the solver uses
+// it, so it is mapped into memory with mmap and solved directly,
+// with no parsing. It is mapped private, the solver's changes to the
+// capacities never go back to the file. The arrays are checked once
+// before solving (CheckCsr), a damaged file is refused.
+//
+// -r renumbers the nodes with reverse Cuthill-McKee before the CSR
+// arrays are built, so nodes next to each other in the graph are
+// close in memory. Node ids in DIMACS files are often just the order
+// the generator made them in. With -o the saved file keeps the new
+// order, so it is only paid for once.
+//
+// -s drops the nodes that can't carry flow and contracts chains of
+// nodes with one arc in and one arc out (Reduce), then solves the
+// smaller graph. It is one more pass over the arcs, so it only pays
+// when a good part of the graph goes away. With -o the reduced graph
+// is saved.
+//
+// The max flow value is printed first. -f then prints one line per
+// arc, in the order of the file:
+//   f <from> <to> <flow>
+// -c prints the nodes on the source side of a min cut, one per line:
+//   n <id>
+// Both are for the arcs and node ids of the file, with or without -r
+// and -s. They need the DIMACS file, a CSR file has lost the order.
+
+#include <iostream>
+#include <vector>
+#include <deque>
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace std;
+
+//============================================================
+// ResidualGraph
+//============================================================
+/*
+  Residual graph in CSR form. Arcs of vertex v are
+  [first[v], first[v+1]), every arc has a reverse arc rev[a].
+  The arrays are owned by whoever loaded the graph.
+*/
+struct ResidualGraph {
+  int num_verts;
+  int num_arcs;
+  int source, sink;
+  int *first; // num_verts + 1
+  int *to;    // num_arcs
+  int *rev;   // num_arcs
+  int *c_f;   // num_arcs, residual capacity.
+};
+
+// Binary file layout: header, then first, to, rev, c_f.
+struct CsrHeader {
+  char magic[8];
+  int32_t num_verts;
+  int32_t num_arcs;
+  int32_t source;
+  int32_t sink;
+};
+const char CSR_MAGIC[8] = {'M','A','X','F','L','O','W','1'};
+
+//============================================================
+// BoykovKolmogorov
+//============================================================
+/*
+  Same algorithm as in 1_1000/500/563.cpp, but it works in place on
+  a ResidualGraph, so a mapped file can be solved as is.
+  Both search trees are kept between augmentations, only the vertices
+  cut off from their tree (orphans) are fixed after pushing flow.
+*/
+class BoykovKolmogorov
+{
+public:
+  BoykovKolmogorov(ResidualGraph &g)
+      : _g(g)
+  {}
+
+  // returns max flow.
+  long long MaxFlow() {
+    const int n = _g.num_verts;
+    _tree.assign(n, FREE);
+    _parent.assign(n, NO_PARENT);
+    _ts.assign(n, 0);
+    _dist.assign(n, 0);
+    _time = 0;
+    _active.clear();
+    _orphans.clear();
+
+    _tree[_g.source] = S_TREE;
+    _parent[_g.source] = TERMINAL;
+    _tree[_g.sink] = T_TREE;
+    _parent[_g.sink] = TERMINAL;
+    _active.push_back(_g.source);
+    _active.push_back(_g.sink);
+
+    long long max_flow = 0;
+    while(!_active.empty()) {
+      int p = _active.front();
+      _active.pop_front();
+      if(_tree[p] == FREE) continue; // was freed after it was made active.
+
+      // ===== Grow =====
+      // meet = arc going from the S tree into the T tree.
+      int meet = -1;
+      for(int a = _g.first[p]; a < _g.first[p + 1]; ++a) {
+        int q = _g.to[a];
+        // residual capacity in the direction away from the tree root.
+        int c = _tree[p] == S_TREE ? _g.c_f[a] : _g.c_f[_g.rev[a]];
+        if(c <= 0) continue;
+
+        if(_tree[q] == FREE) {
+          _tree[q] = _tree[p];
+          _parent[q] = _g.rev[a]; // arc from q to its parent p.
+          _ts[q] = _ts[p];
+          _dist[q] = _dist[p] + 1;
+          _active.push_back(q);
+        }else if(_tree[q] != _tree[p]) {
+          meet = _tree[p] == S_TREE ? a : _g.rev[a];
+          break;
+        }
+      }
+      if(meet < 0) continue; // p has no more free neighbors.
+
+      // p might still have more neighbors to grow into.
+      _active.push_front(p);
+
+      // ===== Augment =====
+      ++_time;
+      max_flow += Augment(meet);
+
+      // ===== Adopt =====
+      while(!_orphans.empty()) {
+        int v = _orphans.front();
+        _orphans.pop_front();
+        Adopt(v);
+      }
+    }
+
+    return max_flow;
+  }
+
+private:
+  enum { FREE, S_TREE, T_TREE };
+  // Special values of _parent.
+  enum { NO_PARENT = -1, TERMINAL = -2, ORPHAN = -3 };
+  enum { INF_DIST = 999999999 };
+
+  ResidualGraph &_g;
+
+  // Search trees.
+  vector<int> _tree;
+  // _parent[v] = arc from v to its parent.
+  vector<int> _parent;
+  // Time stamp and distance to the terminal, for choosing new parents.
+  vector<int> _ts;
+  vector<int> _dist;
+  int _time;
+  deque<int> _active;
+  deque<int> _orphans;
+
+  // Send flow along the path source -> ... -> meet -> ... -> sink.
+  // Saturated tree arcs create orphans.
+  int Augment(int meet) {
+    const int *to = _g.to;
+    const int *rev = _g.rev;
+    int *c_f = _g.c_f;
+
+    // Find c_f_p (min of all c_f in this path)
+    int c_f_p = c_f[meet];
+    for(int v = to[rev[meet]]; _parent[v] != TERMINAL; v = to[_parent[v]])
+      c_f_p = min(c_f_p, c_f[rev[_parent[v]]]);
+    for(int v = to[meet]; _parent[v] != TERMINAL; v = to[_parent[v]])
+      c_f_p = min(c_f_p, c_f[_parent[v]]);
+
+    // send flow through
+    Push(meet, c_f_p);
+    for(int v = to[rev[meet]]; _parent[v] != TERMINAL; ) {
+      int a = _parent[v];
+      int next = to[a];
+      Push(rev[a], c_f_p);
+      if(c_f[rev[a]] == 0) {
+        _parent[v] = ORPHAN;
+        _orphans.push_back(v);
+      }
+      v = next;
+    }
+    for(int v = to[meet]; _parent[v] != TERMINAL; ) {
+      int a = _parent[v];
+      int next = to[a];
+      Push(a, c_f_p);
+      if(c_f[a] == 0) {
+        _parent[v] = ORPHAN;
+        _orphans.push_back(v);
+      }
+      v = next;
+    }
+    return c_f_p;
+  }
+
+  void Push(int a, int f) {
+    _g.c_f[a] -= f;
+    _g.c_f[_g.rev[a]] += f;
+  }
+
+  // Try to find a new parent for v in its own tree,
+  // otherwise v becomes free.
+  void Adopt(int v) {
+    const int t = _tree[v];
+    int best = NO_PARENT;
+    int best_dist = INF_DIST;
+
+    for(int a = _g.first[v]; a < _g.first[v + 1]; ++a) {
+      int q = _g.to[a];
+      if(_tree[q] != t) continue;
+      // q must be able to send flow to v (S), or get flow from v (T).
+      if((t == S_TREE ? _g.c_f[_g.rev[a]] : _g.c_f[a]) <= 0) continue;
+
+      // Check q is still connected to the terminal, and how far.
+      int d = 0;
+      int j = q;
+      for(;;) {
+        if(_ts[j] == _time) { d += _dist[j]; break; }
+        if(_parent[j] == TERMINAL) {
+          _ts[j] = _time;
+          _dist[j] = 1;
+          ++d;
+          break;
+        }
+        if(_parent[j] == ORPHAN) { d = INF_DIST; break; }
+        ++d;
+        j = _g.to[_parent[j]];
+      }
+      if(d >= INF_DIST) continue;
+
+      if(d < best_dist) {
+        best = a;
+        best_dist = d;
+      }
+      // Mark the path from q so later searches stop early.
+      for(j = q; _ts[j] != _time; j = _g.to[_parent[j]]) {
+        _ts[j] = _time;
+        _dist[j] = d--;
+      }
+    }
+
+    if(best != NO_PARENT) {
+      _parent[v] = best;
+      _ts[v] = _time;
+      _dist[v] = best_dist + 1;
+      return;
+    }
+
+    // No parent found. Neighbors in the tree may be able to
+    // reach v's old subtree now, and v's children become orphans.
+    for(int a = _g.first[v]; a < _g.first[v + 1]; ++a) {
+      int q = _g.to[a];
+      if(_tree[q] != t) continue;
+      if((t == S_TREE ? _g.c_f[_g.rev[a]] : _g.c_f[a]) > 0)
+        _active.push_back(q);
+      if(_parent[q] >= 0 && _g.to[_parent[q]] == v) {
+        _parent[q] = ORPHAN;
+        _orphans.push_back(q);
+      }
+    }
+    _tree[v] = FREE;
+    _parent[v] = NO_PARENT;
+  }
+};
+//============================================================
+
+//============================================================
+// MappedFile
+//============================================================
+/*
+  A whole file mapped into memory, private copy on write.
+*/
+class MappedFile
+{
+public:
+  MappedFile()
+      : _data(0), _size(0)
+  {}
+  ~MappedFile() {
+    if(_data)
+      munmap(_data, _size);
+  }
+
+  // returns false if the file can't be opened or mapped.
+  bool Open(const char *path) {
+    int fd = open(path, O_RDONLY);
+    if(fd < 0) return false;
+    struct stat st;
+    if(fstat(fd, &st) != 0 || st.st_size == 0) {
+      close(fd);
+      return false;
+    }
+    _size = st.st_size;
+    void *p = mmap(0, _size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(p == MAP_FAILED) return false;
+    _data = (char*)p;
+    return true;
+  }
+
+  char* Data() const { return _data; }
+  size_t Size() const { return _size; }
+
+private:
+  char *_data;
+  size_t _size;
+
+  MappedFile(const MappedFile&);
+  void operator=(const MappedFile&);
+};
+//============================================================
+
+//============================================================
+// CuthillMcKeeOrder
+//============================================================
+/*
+  Returns new_idx[v], a new number for each vertex so that vertices
+  next to each other in the graph are close together in memory.
+  This is reverse Cuthill-McKee: a BFS (every arc has its reverse, so
+  this ignores direction) from a low degree vertex, visiting neighbors
+  with fewer arcs first, and then the order is reversed.
+  Vertices with very many arcs (a source or sink hooked up to the
+  whole graph) would put everything one step apart, so they are
+  numbered first and the BFS does not go through them.
+*/
+vector<int> CuthillMcKeeOrder(const ResidualGraph &g)
+{
+  const int HUB_DEGREE = 16;
+  const int n = g.num_verts;
+  auto degree = [&g](int v) { return g.first[v + 1] - g.first[v]; };
+  auto by_degree = [&degree](int a, int b) { return degree(a) < degree(b); };
+
+  vector<int> new_idx(n, -1);
+  int next = 0;
+  for(int v = 0;v < n; ++v)
+    if(degree(v) > HUB_DEGREE)
+      new_idx[v] = next++;
+  const int num_hubs = next;
+
+  // Start each component from the lowest degree vertex left.
+  vector<int> starts;
+  for(int v = 0;v < n; ++v)
+    if(new_idx[v] < 0)
+      starts.push_back(v);
+  stable_sort(starts.begin(), starts.end(), by_degree);
+
+  vector<int> order;
+  order.reserve(n - num_hubs);
+  vector<bool> seen(n, false);
+  for(int start : starts) {
+    if(seen[start]) continue;
+    seen[start] = true;
+    size_t head = order.size();
+    order.push_back(start);
+    for(;head < order.size(); ++head) {
+      int v = order[head];
+      size_t first = order.size();
+      for(int a = g.first[v]; a < g.first[v + 1]; ++a) {
+        int to = g.to[a];
+        if(new_idx[to] < 0 && !seen[to]) {
+          seen[to] = true;
+          order.push_back(to);
+        }
+      }
+      stable_sort(order.begin() + first, order.end(), by_degree);
+    }
+  }
+
+  // Reverse.
+  for(size_t k = 0;k < order.size(); ++k)
+    new_idx[order[k]] = n - 1 - k;
+  return new_idx;
+}
+//============================================================
+
+//============================================================
+// DIMACS input
+//============================================================
+// The arcs as read from a DIMACS file, vertices zero based.
+struct ArcList {
+  int num_verts;
+  int source, sink;
+  vector<int> from, to, cap;
+};
+
+// Fill in the CSR arrays of g from a list of arcs.
+// Each arc gets a reverse arc with zero capacity.
+// arc_pos[k] = the arc in g for arcs k.
+void BuildResidual(const ArcList &arcs, ResidualGraph &g,
+                   vector<int> &storage, vector<int> &arc_pos)
+{
+  const vector<int> &from = arcs.from, &to = arcs.to, &cap = arcs.cap;
+  g.num_verts = arcs.num_verts;
+  g.source = arcs.source;
+  g.sink = arcs.sink;
+  g.num_arcs = 2 * from.size();
+  storage.assign((g.num_verts + 1) + 3 * size_t(g.num_arcs), 0);
+  g.first = &storage[0];
+  g.to = g.first + g.num_verts + 1;
+  g.rev = g.to + g.num_arcs;
+  g.c_f = g.rev + g.num_arcs;
+
+  for(size_t k = 0;k < from.size(); ++k) {
+    ++g.first[from[k] + 1];
+    ++g.first[to[k] + 1];
+  }
+  for(int v = 0;v < g.num_verts; ++v)
+    g.first[v + 1] += g.first[v];
+
+  vector<int> pos(g.first, g.first + g.num_verts);
+  arc_pos.resize(from.size());
+  for(size_t k = 0;k < from.size(); ++k) {
+    int a = pos[from[k]]++;
+    int b = pos[to[k]]++;
+    arc_pos[k] = a;
+    g.to[a] = to[k];    g.c_f[a] = cap[k]; g.rev[a] = b;
+    g.to[b] = from[k];  g.c_f[b] = 0;      g.rev[b] = a;
+  }
+}
+
+/*
+  Parses DIMACS max flow text into a list of arcs.
+  returns false, with a message on cerr, for bad input.
+*/
+bool ReadDimacs(const char *text, size_t size, ArcList &arcs)
+{
+  const char *p = text;
+  const char *end = text + size;
+
+  auto skip_space = [&]() {
+    while(p < end && (*p == ' ' || *p == '\t' || *p == '\r')) ++p;
+  };
+  auto read_int = [&](long long &x) -> bool {
+    skip_space();
+    bool neg = false;
+    if(p < end && *p == '-') { neg = true; ++p; }
+    if(p >= end || *p < '0' || *p > '9') return false;
+    x = 0;
+    while(p < end && *p >= '0' && *p <= '9') {
+      x = x * 10 + (*p++ - '0');
+      // nothing in the file can be this big, stop before x overflows.
+      if(x > INT32_MAX) return false;
+    }
+    if(neg) x = -x;
+    return true;
+  };
+
+  long long n = -1, m = 0;
+  long long source = -1, sink = -1;
+  vector<int> &from = arcs.from, &to = arcs.to, &cap = arcs.cap;
+  from.clear();
+  to.clear();
+  cap.clear();
+  int line = 0;
+
+  while(p < end) {
+    ++line;
+    skip_space();
+    char type = p < end ? *p++ : '\n';
+    if(type == '\n') continue; // empty line.
+    bool ok = true;
+
+    if(type == 'p') {
+      skip_space();
+      if(end - p < 3 || strncmp(p, "max", 3) != 0) {
+        cerr << "line " << line << ": only 'p max' problems are supported\n";
+        return false;
+      }
+      p += 3;
+      ok = read_int(n) && read_int(m) && n > 0 && m >= 0
+          && n < INT32_MAX && 2 * m < INT32_MAX;
+      if(ok) {
+        from.reserve(m);
+        to.reserve(m);
+        cap.reserve(m);
+      }
+    }else if(type == 'n') {
+      long long id = 0;
+      ok = read_int(id) && id >= 1 && id <= n;
+      skip_space();
+      if(ok && p < end && *p == 's') source = id - 1;
+      else if(ok && p < end && *p == 't') sink = id - 1;
+      else ok = false;
+      ++p;
+    }else if(type == 'a') {
+      long long u, v, c;
+      ok = n > 0 && read_int(u) && read_int(v) && read_int(c)
+          && u >= 1 && u <= n && v >= 1 && v <= n
+          && c >= 0 && c <= INT32_MAX;
+      if(ok) {
+        from.push_back(u - 1);
+        to.push_back(v - 1);
+        cap.push_back(c);
+      }
+    }else if(type != 'c') {
+      ok = false;
+    }
+
+    if(!ok) {
+      cerr << "line " << line << ": bad input\n";
+      return false;
+    }
+    // rest of the line.
+    while(p < end && *p != '\n') ++p;
+    if(p < end) ++p;
+  }
+
+  if(n <= 0 || source < 0 || sink < 0 || source == sink) {
+    cerr << "missing 'p max' line, source or sink\n";
+    return false;
+  }
+  if(2 * (long long)from.size() >= INT32_MAX) {
+    cerr << "too many arcs\n";
+    return false;
+  }
+
+  arcs.num_verts = n;
+  arcs.source = source;
+  arcs.sink = sink;
+  return true;
+}
+//============================================================
+
+//============================================================
+// Reduce
+//============================================================
+// Arc ids grouped by ends[k] (from or to), CSR style:
+// ids[first[v] .. first[v+1]) are the alive arcs with ends[k] == v.
+void GroupArcs(const vector<int> &ends, const vector<char> &alive,
+               int n, vector<int> &first, vector<int> &ids)
+{
+  first.assign(n + 1, 0);
+  for(size_t k = 0;k < ends.size(); ++k)
+    if(alive[k]) ++first[ends[k] + 1];
+  for(int v = 0;v < n; ++v)
+    first[v + 1] += first[v];
+  ids.resize(first[n]);
+  vector<int> pos(first.begin(), first.end() - 1);
+  for(size_t k = 0;k < ends.size(); ++k)
+    if(alive[k]) ids[pos[ends[k]]++] = k;
+}
+
+// Vertices reachable from start, going from v to next[k]
+// for each arc k in the group of v.
+vector<char> Reach(const vector<int> &first, const vector<int> &ids,
+                   const vector<int> &next, int start)
+{
+  vector<char> seen(first.size() - 1, false);
+  vector<int> s;
+  s.push_back(start);
+  seen[start] = true;
+  for(size_t head = 0;head < s.size(); ++head) {
+    int v = s[head];
+    for(int j = first[v]; j < first[v + 1]; ++j) {
+      int w = next[ids[j]];
+      if(!seen[w]) {
+        seen[w] = true;
+        s.push_back(w);
+      }
+    }
+  }
+  return seen;
+}
+
+/*
+  Make a smaller graph with the same max flow, before the CSR arrays
+  are built (-s).
+  - Arcs with no capacity, loops, arcs into the source and arcs out
+    of the sink are never on a path from the source to the sink.
+  - Vertices that can't be reached from the source, or can't reach
+    the sink, can never carry flow. They are removed with their arcs.
+  - A vertex with exactly one arc in and one arc out only passes flow
+    along. A chain u -> v -> ... -> w becomes one arc u -> w with the
+    min of the capacities.
+  The vertices left keep their order, numbered again from 0.
+  reduced_arc[k] = the arc in reduced that arc k became part of,
+  -1 if it was dropped. (all arcs in a chain carry the same flow)
+*/
+void Reduce(const ArcList &arcs, ArcList &reduced,
+            vector<int> &reduced_arc)
+{
+  const int n = arcs.num_verts;
+  const int m = arcs.from.size();
+  const vector<int> &from = arcs.from, &to = arcs.to, &cap = arcs.cap;
+
+  // ===== Prune =====
+  vector<char> alive(m);
+  for(int k = 0;k < m; ++k)
+    alive[k] = cap[k] > 0 && from[k] != to[k]
+        && to[k] != arcs.source && from[k] != arcs.sink;
+
+  vector<int> out_first, out, in_first, in;
+  GroupArcs(from, alive, n, out_first, out);
+  GroupArcs(to, alive, n, in_first, in);
+  vector<char> keep = Reach(out_first, out, to, arcs.source);
+  vector<char> to_sink = Reach(in_first, in, from, arcs.sink);
+  for(int v = 0;v < n; ++v)
+    keep[v] = keep[v] && to_sink[v];
+  keep[arcs.source] = keep[arcs.sink] = true;
+
+  // next[v] = the one arc out of v, if v is in the middle of a chain.
+  vector<int> num_in(n, 0), num_out(n, 0), next(n, -1);
+  for(int k = 0;k < m; ++k) {
+    alive[k] = alive[k] && keep[from[k]] && keep[to[k]];
+    if(!alive[k]) continue;
+    ++num_out[from[k]];
+    ++num_in[to[k]];
+    next[from[k]] = k;
+  }
+  for(int v = 0;v < n; ++v)
+    if(num_in[v] != 1 || num_out[v] != 1
+       || v == arcs.source || v == arcs.sink)
+      next[v] = -1;
+
+  // ===== Renumber =====
+  vector<int> new_idx(n, -1);
+  int num_verts = 0;
+  for(int v = 0;v < n; ++v)
+    if(keep[v] && next[v] < 0)
+      new_idx[v] = num_verts++;
+  reduced.num_verts = num_verts;
+  reduced.source = new_idx[arcs.source];
+  reduced.sink = new_idx[arcs.sink];
+
+  // ===== Contract =====
+  // Every chain starts with an arc out of a vertex that is kept.
+  // A chain can't run into itself, each vertex in it has one arc in.
+  reduced.from.clear();
+  reduced.to.clear();
+  reduced.cap.clear();
+  reduced.from.reserve(m);
+  reduced.to.reserve(m);
+  reduced.cap.reserve(m);
+  reduced_arc.assign(m, -1);
+  for(int k = 0;k < m; ++k) {
+    if(!alive[k] || new_idx[from[k]] < 0) continue;
+    int c = cap[k];
+    int w = to[k];
+    while(next[w] >= 0) {
+      c = min(c, cap[next[w]]);
+      w = to[next[w]];
+    }
+    if(w == from[k]) continue; // went around back to the start.
+    // k and the rest of its chain become arc j.
+    const int j = reduced.from.size();
+    reduced_arc[k] = j;
+    for(int v = to[k]; next[v] >= 0; v = to[next[v]])
+      reduced_arc[next[v]] = j;
+    reduced.from.push_back(new_idx[from[k]]);
+    reduced.to.push_back(new_idx[w]);
+    reduced.cap.push_back(c);
+  }
+}
+//============================================================
+
+//============================================================
+// Binary CSR file
+//============================================================
+bool WriteCsr(const char *path, const ResidualGraph &g)
+{
+  FILE *f = fopen(path, "wb");
+  if(!f) return false;
+  CsrHeader h;
+  memcpy(h.magic, CSR_MAGIC, sizeof(h.magic));
+  h.num_verts = g.num_verts;
+  h.num_arcs = g.num_arcs;
+  h.source = g.source;
+  h.sink = g.sink;
+  bool ok = fwrite(&h, sizeof(h), 1, f) == 1
+      && fwrite(g.first, sizeof(int), g.num_verts + 1, f) == size_t(g.num_verts + 1)
+      && fwrite(g.to, sizeof(int), g.num_arcs, f) == size_t(g.num_arcs)
+      && fwrite(g.rev, sizeof(int), g.num_arcs, f) == size_t(g.num_arcs)
+      && fwrite(g.c_f, sizeof(int), g.num_arcs, f) == size_t(g.num_arcs);
+  return fclose(f) == 0 && ok;
+}
+
+bool IsCsr(const MappedFile &file)
+{
+  return file.Size() >= sizeof(CsrHeader)
+      && memcmp(file.Data(), CSR_MAGIC, sizeof(CSR_MAGIC)) == 0;
+}
+
+/*
+  A file that was cut short, padded, or written by something else
+  could send the solver outside the arrays, so check every index once
+  before solving. It is one pass over the arcs, much cheaper than
+  parsing the text.
+  - first[] starts at 0, never goes down, and ends at num_arcs.
+  - every to[] is a vertex, every rev[] is an arc.
+  - rev[rev[a]] == a, and the reverse arc goes back to where a starts.
+  - capacities are not negative, and an arc plus its reverse arc
+    fit in an int (that is the original capacity, pushing flow only
+    moves it from one to the other).
+*/
+bool CheckCsr(const ResidualGraph &g)
+{
+  const int n = g.num_verts;
+  if(g.first[0] != 0 || g.first[n] != g.num_arcs)
+    return false;
+  for(int v = 0;v < n; ++v)
+    if(g.first[v + 1] < g.first[v])
+      return false;
+  for(int v = 0;v < n; ++v)
+    for(int a = g.first[v]; a < g.first[v + 1]; ++a) {
+      int b = g.rev[a];
+      if(g.to[a] < 0 || g.to[a] >= n
+         || b < 0 || b >= g.num_arcs
+         || g.rev[b] != a || g.to[b] != v
+         || g.c_f[a] < 0
+         || (long long)g.c_f[a] + g.c_f[b] > INT32_MAX)
+        return false;
+    }
+  return true;
+}
+
+// Point g at the arrays inside the mapped file.
+bool MapCsr(const MappedFile &file, ResidualGraph &g)
+{
+  CsrHeader h;
+  memcpy(&h, file.Data(), sizeof(h));
+  size_t need = sizeof(h)
+      + sizeof(int) * ((size_t)h.num_verts + 1 + 3 * (size_t)h.num_arcs);
+  if(h.num_verts <= 0 || h.num_arcs < 0 || file.Size() != need
+     || h.source < 0 || h.source >= h.num_verts
+     || h.sink < 0 || h.sink >= h.num_verts) {
+    cerr << "bad CSR file\n";
+    return false;
+  }
+  g.num_verts = h.num_verts;
+  g.num_arcs = h.num_arcs;
+  g.source = h.source;
+  g.sink = h.sink;
+  g.first = (int*)(file.Data() + sizeof(h));
+  g.to = g.first + g.num_verts + 1;
+  g.rev = g.to + g.num_arcs;
+  g.c_f = g.rev + g.num_arcs;
+  if(!CheckCsr(g)) {
+    cerr << "bad CSR file, the arrays don't make a residual graph\n";
+    return false;
+  }
+  return true;
+}
+//============================================================
+
+//============================================================
+// Min cut
+//============================================================
+/*
+  The source side of the min cut, side[v] true for the nodes the
+  source can still reach when arc k carries flow[k]: forwards along
+  an arc that isn't full, backwards along one with flow.
+  flow has to be a max flow for arcs.
+*/
+vector<char> SourceSide(const ArcList &arcs, const vector<int> &flow)
+{
+  const int n = arcs.num_verts;
+  vector<char> all(arcs.from.size(), true);
+  vector<int> out_first, out, in_first, in;
+  GroupArcs(arcs.from, all, n, out_first, out);
+  GroupArcs(arcs.to, all, n, in_first, in);
+
+  vector<char> side(n, false);
+  vector<int> s;
+  s.push_back(arcs.source);
+  side[arcs.source] = true;
+  for(size_t head = 0;head < s.size(); ++head) {
+    int v = s[head];
+    for(int j = out_first[v]; j < out_first[v + 1]; ++j) {
+      int k = out[j];
+      if(flow[k] < arcs.cap[k] && !side[arcs.to[k]]) {
+        side[arcs.to[k]] = true;
+        s.push_back(arcs.to[k]);
+      }
+    }
+    for(int j = in_first[v]; j < in_first[v + 1]; ++j) {
+      int k = in[j];
+      if(flow[k] > 0 && !side[arcs.from[k]]) {
+        side[arcs.from[k]] = true;
+        s.push_back(arcs.from[k]);
+      }
+    }
+  }
+  return side;
+}
+//============================================================
+
+int main(int argc, char **argv)
+{
+  const char *in_path = 0;
+  const char *out_path = 0;
+  bool reorder = false;
+  bool reduce = false;
+  bool print_flows = false;
+  bool print_cut = false;
+  bool bad_args = false;
+  for(int k = 1;k < argc; ++k) {
+    if(strcmp(argv[k], "-o") == 0 && k + 1 < argc)
+      out_path = argv[++k];
+    else if(strcmp(argv[k], "-r") == 0)
+      reorder = true;
+    else if(strcmp(argv[k], "-s") == 0)
+      reduce = true;
+    else if(strcmp(argv[k], "-f") == 0)
+      print_flows = true;
+    else if(strcmp(argv[k], "-c") == 0)
+      print_cut = true;
+    else if(!in_path)
+      in_path = argv[k];
+    else
+      bad_args = true;
+  }
+  if(!in_path || bad_args) {
+    cerr << "usage: " << argv[0]
+         << " [-r] [-s] [-f] [-c] <graph.max | graph.csr> [-o graph.csr]\n";
+    return 1;
+  }
+
+  MappedFile file;
+  if(!file.Open(in_path)) {
+    cerr << "can't read " << in_path << '\n';
+    return 1;
+  }
+
+  ResidualGraph g;
+  vector<int> storage;
+  ArcList arcs; // as read, for -f and -c.
+  // arc_pos[j] = arc in g for arc j of the list that was solved.
+  // reduced_arc[k] = j for arc k of arcs, -1 if it was dropped. (-s)
+  vector<int> arc_pos, reduced_arc;
+  if(IsCsr(file)) {
+    // Already in the order it was saved in.
+    if(reorder || reduce)
+      cerr << "-r and -s do nothing for a CSR file\n";
+    if(print_flows || print_cut) {
+      cerr << "-f and -c need the DIMACS file, the CSR file doesn't"
+           << " have the arcs in their original order\n";
+      return 1;
+    }
+    if(!MapCsr(file, g)) return 1;
+  }else{
+    if(!ReadDimacs(file.Data(), file.Size(), arcs))
+      return 1;
+    ArcList solved; // what g is built from, when it isn't arcs.
+    ArcList *solve = &arcs;
+    if(reduce) {
+      Reduce(arcs, solved, reduced_arc);
+      cerr << "-s: " << arcs.num_verts << " nodes " << arcs.from.size()
+           << " arcs -> " << solved.num_verts << " nodes "
+           << solved.from.size() << " arcs\n";
+      solve = &solved;
+    }else if(reorder && (print_flows || print_cut)) {
+      // -r renumbers what it solves, keep the ids in the file.
+      solved = arcs;
+      solve = &solved;
+    }
+    BuildResidual(*solve, g, storage, arc_pos);
+    if(reorder) {
+      // The ordering needs the arcs of each vertex, so build once,
+      // then again with the new numbers. Arc numbers stay the same.
+      vector<int> new_idx = CuthillMcKeeOrder(g);
+      for(int &v : solve->from) v = new_idx[v];
+      for(int &v : solve->to) v = new_idx[v];
+      solve->source = new_idx[solve->source];
+      solve->sink = new_idx[solve->sink];
+      BuildResidual(*solve, g, storage, arc_pos);
+    }
+  }
+
+  // Save before solving, the solver changes c_f.
+  if(out_path && !WriteCsr(out_path, g)) {
+    cerr << "can't write " << out_path << '\n';
+    return 1;
+  }
+
+  cout << BoykovKolmogorov(g).MaxFlow() << '\n';
+  if(!print_flows && !print_cut)
+    return 0;
+
+  // Back to the arcs in the file.
+  // The flow on an arc is what its reverse arc has now.
+  vector<int> flow(arcs.from.size(), 0);
+  for(size_t k = 0;k < flow.size(); ++k) {
+    int j = reduce ? reduced_arc[k] : k;
+    if(j >= 0)
+      flow[k] = g.c_f[g.rev[arc_pos[j]]];
+  }
+  if(print_flows)
+    for(size_t k = 0;k < flow.size(); ++k)
+      cout << "f " << arcs.from[k] + 1 << ' ' << arcs.to[k] + 1
+           << ' ' << flow[k] << '\n';
+  if(print_cut) {
+    vector<char> side = SourceSide(arcs, flow);
+    for(int v = 0;v < arcs.num_verts; ++v)
+      if(side[v])
+        cout << "n " << v + 1 << '\n';
+  }
+}
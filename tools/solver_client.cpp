@@ -0,0 +1,126 @@
+// Sends an input file to solverd and times the answers.
+//
+// Usage:
+//   solver_client <socket> <problem> <input file> [repeat]
+//
+// The input is sent 'repeat' times (default 1), one request after
+// the other. The first answer goes to stdout, so it can be compared
+// with build/<problem> < input. Times go to stderr.
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <cerrno>
+#include <cstdlib>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace std;
+
+bool WriteAll(int fd, const string &s)
+{
+  size_t done = 0;
+  while(done < s.size()) {
+    ssize_t w = write(fd, s.data() + done, s.size() - done);
+    if(w < 0 && errno == EINTR) continue;
+    if(w <= 0) return false;
+    done += w;
+  }
+  return true;
+}
+
+// Read one answer. false if the connection closed or it was an error.
+bool ReadAnswer(int fd, string &buf, string &answer)
+{
+  char tmp[1 << 16];
+  size_t nl;
+  while((nl = buf.find('\n')) == string::npos) {
+    ssize_t r = read(fd, tmp, sizeof(tmp));
+    if(r <= 0) return false;
+    buf.append(tmp, r);
+  }
+  string header = buf.substr(0, nl);
+  if(header.compare(0, 3, "OK ") != 0) {
+    cerr << header << '\n';
+    return false;
+  }
+  size_t num_bytes = strtoull(header.c_str() + 3, 0, 10);
+  while(buf.size() - (nl + 1) < num_bytes) {
+    ssize_t r = read(fd, tmp, sizeof(tmp));
+    if(r <= 0) return false;
+    buf.append(tmp, r);
+  }
+  answer.assign(buf, nl + 1, num_bytes);
+  buf.erase(0, nl + 1 + num_bytes);
+  return true;
+}
+
+int main(int argc, char **argv)
+{
+  if(argc < 4 || argc > 5) {
+    cerr << "usage: " << argv[0]
+         << " <socket> <problem> <input file> [repeat]\n";
+    return 1;
+  }
+  const char *path = argv[1];
+  string problem = argv[2];
+  int repeat = argc == 5 ? atoi(argv[4]) : 1;
+  if(repeat < 1) repeat = 1;
+
+  ifstream f(argv[3], ios::binary);
+  if(!f) {
+    cerr << "can't read " << argv[3] << '\n';
+    return 1;
+  }
+  stringstream ss;
+  ss << f.rdbuf();
+  const string input = ss.str();
+  const string request =
+      problem + " " + to_string(input.size()) + "\n" + input;
+
+  sockaddr_un addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  if(strlen(path) >= sizeof(addr.sun_path)) {
+    cerr << "socket path too long\n";
+    return 1;
+  }
+  strcpy(addr.sun_path, path);
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if(fd < 0 || connect(fd, (sockaddr*)&addr, sizeof(addr)) != 0) {
+    cerr << "can't connect to " << path << ": " << strerror(errno) << '\n';
+    return 1;
+  }
+
+  // latency of each request, in microseconds.
+  vector<double> times;
+  string buf, answer;
+  auto start = chrono::steady_clock::now();
+  for(int k = 0;k < repeat; ++k) {
+    auto t0 = chrono::steady_clock::now();
+    if(!WriteAll(fd, request) || !ReadAnswer(fd, buf, answer)) {
+      cerr << "request " << k << " failed\n";
+      return 1;
+    }
+    auto t1 = chrono::steady_clock::now();
+    times.push_back(chrono::duration<double, micro>(t1 - t0).count());
+    if(k == 0)
+      cout << answer;
+  }
+  double total = chrono::duration<double>(
+      chrono::steady_clock::now() - start).count();
+  close(fd);
+
+  sort(times.begin(), times.end());
+  cerr << repeat << " requests in " << total << " s, "
+       << repeat / total << " requests/s\n"
+       << "latency us: min " << times.front()
+       << " median " << times[times.size() / 2]
+       << " max " << times.back() << '\n';
+}
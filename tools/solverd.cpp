@@ -0,0 +1,279 @@
+// Solver daemon for the max flow problems (563, 753, 820).
+//
+// Stays running and solves problem instances sent to it, so tiny
+// inputs don't pay for process startup and cold caches each time.
+//
+// Usage:
+//   solverd                 read requests on stdin, answer on stdout
+//   solverd -s <socket>     listen on a Unix domain socket
+//
+// Each request is a header line, then the problem input:
+//   <problem> <num_bytes>\n<num_bytes bytes of UVa input>
+// Each answer is:
+//   OK <num_bytes>\n<num_bytes bytes of output>
+// or
+//   ERR <message>\n
+// The output is exactly what build/<problem> prints for that input.
+// If the solver throws (bad input it can't handle), the answer is an
+// ERR and the daemon keeps going.
+// See tools/solver_client.cpp to replay input files through it.
+//
+// What stays warm between requests is the process, the allocator and
+// the I/O buffers. The solvers still build their graphs and max flow
+// engines fresh for every problem, the same as the normal binaries.
+
+// Everything the solutions include, so the includes inside the
+// namespaces below do nothing.
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <cstdlib>
+#include <cstdint>
+#include <climits>
+#include <cstring>
+#include <cerrno>
+#include <algorithm>
+#include <vector>
+#include <map>
+#include <set>
+#include <queue>
+#include <deque>
+#include <stack>
+#include <csignal>
+#include <exception>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#ifdef PROFILE
+#include "profile.h"
+#endif
+
+// Each solution goes in its own namespace, they all have their own
+// edge / FordFulkerson. Their main() is never called.
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wreturn-type"
+#define main unused_main
+namespace uva563 {
+#include "../1_1000/500/563.cpp"
+}
+namespace uva753 {
+#include "../1_1000/700/753.cpp"
+}
+namespace uva820 {
+#include "../1_1000/800/820.cpp"
+}
+#undef main
+#pragma GCC diagnostic pop
+
+using namespace std;
+
+//============================================================
+// Solvers
+//============================================================
+// These are the main() loops of each problem, they stop early if the
+// input runs out.
+
+void Solve563()
+{
+  int num_problems;
+  cin >> num_problems;
+  for(int p = 0;p < num_problems && cin; ++p)
+    uva563::Solve();
+}
+
+void Solve753()
+{
+  int num_tests;
+  cin >> num_tests;
+  for(int k = 0;k < num_tests && cin;++k)
+    uva753::Solve();
+}
+
+void Solve820()
+{
+  for(int k = 1; cin && uva820::Solve(k) ;++k);
+}
+
+//============================================================
+// SolverDaemon
+//============================================================
+class SolverDaemon
+{
+public:
+  // Bigger requests are refused. (the UVa inputs are a few MB at most)
+  enum { MAX_REQUEST_BYTES = 256 << 20 };
+
+  SolverDaemon() {
+    _solvers["563"] = Solve563;
+    _solvers["753"] = Solve753;
+    _solvers["820"] = Solve820;
+  }
+
+  // Answer requests from in_fd on out_fd until end of input.
+  void Serve(int in_fd, int out_fd) {
+    _in_fd = in_fd;
+    _out_fd = out_fd;
+    _buf.clear();
+    _buf_pos = 0;
+
+    string header;
+    while(ReadLine(header)) {
+      istringstream h(header);
+      string problem;
+      long long num_bytes = -1;
+      h >> problem >> num_bytes;
+      if(num_bytes < 0) {
+        Reply("ERR bad header\n");
+        return; // can't tell where the next request starts.
+      }
+      if(num_bytes > MAX_REQUEST_BYTES) {
+        Reply("ERR request too big\n");
+        return; // not reading all that to find the next one.
+      }
+      if(!Read(_input, num_bytes)) return;
+
+      auto s = _solvers.find(problem);
+      if(s == _solvers.end()) {
+        Reply("ERR unknown problem " + problem + "\n");
+        continue;
+      }
+
+      // Run the solver on the request, the buffers are reused.
+      _in.str(_input);
+      _in.clear();
+      _out.str(string());
+      _out.clear();
+      streambuf *old_in = cin.rdbuf(_in.rdbuf());
+      streambuf *old_out = cout.rdbuf(_out.rdbuf());
+      cin.clear();
+      bool failed = false;
+      string error;
+      try {
+        s->second();
+      } catch(const exception &e) {
+        failed = true;
+        error = e.what();
+      } catch(...) {
+        failed = true;
+        error = "unknown exception";
+      }
+      cin.rdbuf(old_in);
+      cout.rdbuf(old_out);
+      cin.clear();
+      cout.clear();
+
+      if(failed) {
+        // keep the answer to one line.
+        replace(error.begin(), error.end(), '\n', ' ');
+        Reply("ERR " + problem + " failed: " + error + "\n");
+        continue;
+      }
+      const string &answer = _out.str();
+      Reply("OK " + to_string(answer.size()) + "\n" + answer);
+    }
+  }
+
+private:
+  map<string, void(*)()> _solvers;
+  int _in_fd, _out_fd;
+  // Bytes read from _in_fd but not used yet.
+  string _buf;
+  size_t _buf_pos;
+  string _input;
+  istringstream _in;
+  ostringstream _out;
+
+  // Get more bytes into _buf, false at end of input.
+  bool Fill() {
+    if(_buf_pos > 0) {
+      _buf.erase(0, _buf_pos);
+      _buf_pos = 0;
+    }
+    char tmp[1 << 16];
+    ssize_t r;
+    do {
+      r = read(_in_fd, tmp, sizeof(tmp));
+    } while(r < 0 && errno == EINTR);
+    if(r <= 0) return false;
+    _buf.append(tmp, r);
+    return true;
+  }
+
+  bool ReadLine(string &line) {
+    for(;;) {
+      size_t nl = _buf.find('\n', _buf_pos);
+      if(nl != string::npos) {
+        line.assign(_buf, _buf_pos, nl - _buf_pos);
+        _buf_pos = nl + 1;
+        return true;
+      }
+      if(!Fill()) return false;
+    }
+  }
+
+  bool Read(string &s, size_t num_bytes) {
+    while(_buf.size() - _buf_pos < num_bytes)
+      if(!Fill()) return false;
+    s.assign(_buf, _buf_pos, num_bytes);
+    _buf_pos += num_bytes;
+    return true;
+  }
+
+  void Reply(const string &s) {
+    size_t done = 0;
+    while(done < s.size()) {
+      ssize_t w = write(_out_fd, s.data() + done, s.size() - done);
+      if(w < 0 && errno == EINTR) continue;
+      if(w <= 0) return; // the other side went away.
+      done += w;
+    }
+  }
+};
+//============================================================
+
+int main(int argc, char **argv)
+{
+  // Don't die when a client disconnects while we write.
+  signal(SIGPIPE, SIG_IGN);
+
+  SolverDaemon daemon;
+
+  if(argc == 1) {
+    daemon.Serve(0, 1);
+    return 0;
+  }
+  if(argc != 3 || strcmp(argv[1], "-s") != 0) {
+    cerr << "usage: " << argv[0] << " [-s <socket path>]\n";
+    return 1;
+  }
+
+  const char *path = argv[2];
+  sockaddr_un addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  if(strlen(path) >= sizeof(addr.sun_path)) {
+    cerr << "socket path too long\n";
+    return 1;
+  }
+  strcpy(addr.sun_path, path);
+
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  unlink(path);
+  if(fd < 0 || bind(fd, (sockaddr*)&addr, sizeof(addr)) != 0
+     || listen(fd, 16) != 0) {
+    cerr << "can't listen on " << path << ": " << strerror(errno) << '\n';
+    return 1;
+  }
+
+  // One client at a time, each can send any number of requests.
+  for(;;) {
+    int client = accept(fd, 0, 0);
+    if(client < 0) {
+      if(errno == EINTR) continue;
+      cerr << "accept: " << strerror(errno) << '\n';
+      return 1;
+    }
+    daemon.Serve(client, client);
+    close(client);
+  }
+}